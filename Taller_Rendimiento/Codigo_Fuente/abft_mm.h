@@ -0,0 +1,139 @@
+/**************************************************************
+		Pontificia Universidad Javeriana
+	Materia: Sistemas Operativos
+	Tema: Taller de Evaluación de Rendimiento
+	Fichero: verificación ABFT del resultado de la multiplicación.
+	Objetivo: Comprobar C = A·B en O(N²) con sumas de verificación
+				(Huang y Abraham): la suma de cada fila de C debe ser
+				A·(B·e) y la de cada columna (eᵀ·A)·B. Las filas y
+				columnas que no cuadran señalan los elementos erróneos
+				y con ellos el bloque (hilo o proceso) que los calculó.
+				La tolerancia crece con N y con la magnitud de los
+				productos, como el error de redondeo de la suma.
+****************************************************************/
+
+#ifndef ABFT_MM_H
+#define ABFT_MM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+#include "tipos_mm.h"
+
+#define ABFT_MAX_LISTA 8 // Filas o columnas erróneas que se listan por bloque
+
+// Bloque de C [fi,ff) x [ci,cf) calculado por un hilo o proceso
+struct bloque_mm {
+	int fi, ff, ci, cf;
+};
+
+// Cota del error de redondeo de una suma de verificación con N productos por término
+// (eps es el épsilon del acumulador; nunca menor que el de double, en que se calculan las sumas)
+static double tolerancia_abft(int N, double cota, double eps){
+	return (2.0*N + 4) * (eps > DBL_EPSILON ? eps : DBL_EPSILON) * cota;
+}
+
+/* Comprueba las sumas de filas y columnas de C. Si b_transpuesta, mB guarda Bᵀ por
+filas (programa transpuesto). Los elementos se leen como double según el tipo de A, B
+y C. 'bloques' son los bloques de cada hilo o proceso ('quien') para localizar el
+fallo. Devuelve el número de filas más columnas erróneas*/
+static int verificar_abft(int N, const struct tipo_mm *tipo, const void *mA, const void *mB, const void *mC,
+		int b_transpuesta, const struct bloque_mm *bloques, int nBloques, const char *quien){
+	leer_mm_t elem = tipo->leer_elem, acum = tipo->leer_acum;
+	double *sumaB = calloc(N, sizeof(double)), *cotaB = calloc(N, sizeof(double)); // B·e y |B|·e
+	double *sumaA = calloc(N, sizeof(double)), *cotaA = calloc(N, sizeof(double)); // eᵀ·A y eᵀ·|A|
+	double *colC = calloc(N, sizeof(double)), *colEsp = calloc(N, sizeof(double)), *colCota = calloc(N, sizeof(double));
+	char *filaMal = calloc(N, 1), *colMal = calloc(N, 1);
+	int nFilas = 0, nCols = 0;
+	double peor = 0.0; // Mayor desvío relativo a la tolerancia
+
+	if(!sumaB || !cotaB || !sumaA || !cotaA || !colC || !colEsp || !colCota || !filaMal || !colMal){
+		perror("Error al reservar memoria para la verificación");
+		exit(EXIT_FAILURE);
+	}
+
+	// Sumas de verificación de A (por columnas) y de B (por filas)
+	for(int i = 0; i < N; i++)
+		for(int k = 0; k < N; k++){
+			double a = elem(mA, (size_t) i*N+k);
+			sumaA[k] += a;
+			cotaA[k] += fabs(a);
+			double b = elem(mB, (size_t) i*N+k); // B(i,k), o B(k,i) si B está transpuesta
+			if(b_transpuesta){
+				sumaB[k] += b;
+				cotaB[k] += fabs(b);
+			} else {
+				sumaB[i] += b;
+				cotaB[i] += fabs(b);
+			}
+		}
+
+	// Filas: suma de la fila i de C frente a A(i,:)·(B·e)
+	for(int i = 0; i < N; i++){
+		double obtenido = 0.0, esperado = 0.0, cota = 0.0;
+		for(int k = 0; k < N; k++){
+			double a = elem(mA, (size_t) i*N+k), c = acum(mC, (size_t) i*N+k);
+			obtenido += c;
+			esperado += a * sumaB[k];
+			cota += fabs(a) * cotaB[k];
+			colC[k] += c;
+		}
+		double tol = tolerancia_abft(N, cota, tipo->eps);
+		double desvio = fabs(obtenido - esperado);
+		if(!(desvio <= tol)){ // También detecta NaN
+			filaMal[i] = 1;
+			nFilas++;
+		}
+		if(tol > 0 && desvio / tol > peor) peor = desvio / tol;
+	}
+
+	// Columnas: suma de la columna j de C frente a (eᵀ·A)·B(:,j)
+	for(int x = 0; x < N; x++)
+		for(int y = 0; y < N; y++){
+			double b = elem(mB, (size_t) x*N+y); // Se recorre mB por filas en ambos casos
+			int k = b_transpuesta ? y : x, j = b_transpuesta ? x : y;
+			colEsp[j] += sumaA[k] * b;
+			colCota[j] += cotaA[k] * fabs(b);
+		}
+	for(int j = 0; j < N; j++){
+		double tol = tolerancia_abft(N, colCota[j], tipo->eps);
+		double desvio = fabs(colC[j] - colEsp[j]);
+		if(!(desvio <= tol)){
+			colMal[j] = 1;
+			nCols++;
+		}
+		if(tol > 0 && desvio / tol > peor) peor = desvio / tol;
+	}
+
+	if(nFilas == 0 && nCols == 0)
+		printf("ABFT: resultado correcto (desvío máximo %.2e de la tolerancia)\n", peor);
+	else {
+		printf("ABFT: ERROR en %d filas y %d columnas de C\n", nFilas, nCols);
+		for(int b = 0; b < nBloques; b++){
+			const struct bloque_mm *q = &bloques[b];
+			int f = 0, c = 0;
+			for(int i = q->fi; i < q->ff; i++) f += filaMal[i];
+			for(int j = q->ci; j < q->cf; j++) c += colMal[j];
+			// Un bloque de franja (todas las columnas) se localiza solo con las filas
+			if(f == 0 || (c == 0 && nCols > 0 && !(q->ci == 0 && q->cf == N)))
+				continue;
+			printf("ABFT: %s %d, bloque [%d,%d)x[%d,%d): %d filas y %d columnas erróneas; filas:",
+				quien, b, q->fi, q->ff, q->ci, q->cf, f, c);
+			for(int i = q->fi, n = 0; i < q->ff && n < ABFT_MAX_LISTA; i++)
+				if(filaMal[i]){ printf(" %d", i); n++; }
+			if(f > ABFT_MAX_LISTA) printf(" ...");
+			printf(", columnas:");
+			for(int j = q->ci, n = 0; j < q->cf && n < ABFT_MAX_LISTA; j++)
+				if(colMal[j]){ printf(" %d", j); n++; }
+			if(c > ABFT_MAX_LISTA) printf(" ...");
+			printf("\n");
+		}
+	}
+
+	free(sumaB); free(cotaB); free(sumaA); free(cotaA);
+	free(colC); free(colEsp); free(colCota); free(filaMal); free(colMal);
+	return nFilas + nCols;
+}
+
+#endif
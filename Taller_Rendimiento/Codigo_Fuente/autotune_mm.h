@@ -0,0 +1,219 @@
+/**************************************************************
+		Pontificia Universidad Javeriana
+	Materia: Sistemas Operativos
+	Tema: Taller de Evaluación de Rendimiento
+	Fichero: ajuste automático (autotune) de la multiplicación.
+	Objetivo: Buscar, para un tamaño N y una máquina, la mejor
+				combinación de kernel (simple o por bloques), tamaño
+				de bloque, número de hilos y afinidad de los hilos.
+				La búsqueda descarta candidatos con ejecuciones cortas
+				(solo una parte de las filas) y guarda el ganador en
+				un fichero de ajuste indexado por programa, modelo de
+				CPU y N, que las ejecuciones normales leen solas.
+****************************************************************/
+
+#ifndef AUTOTUNE_MM_H
+#define AUTOTUNE_MM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define AFINIDAD_NINGUNA  0 // El planificador decide la CPU de cada hilo
+#define AFINIDAD_COMPACTA 1 // Hilos en CPUs consecutivas
+#define AFINIDAD_DISPERSA 2 // Hilos repartidos por todas las CPUs disponibles
+
+#define MAX_CANDIDATOS 128
+#define LINEA_AJUSTE 512
+
+static const char *NOMBRES_AFINIDAD[] = {"ninguna", "compacta", "dispersa"};
+
+// Configuración de una ejecución de la multiplicación
+struct config_mm {
+	int tile;     // Tamaño de bloque del kernel (0 = kernel simple, sin bloques)
+	int hilos;    // Número de hilos
+	int afinidad; // Política de afinidad (AFINIDAD_*)
+	double tiempo; // Mejor tiempo medido en la búsqueda (µs)
+};
+
+// Función que ejecuta una configuración calculando solo las primeras 'filas' filas y devuelve su tiempo en µs
+typedef double (*prueba_mm_t)(int N, const struct config_mm *cfg, int filas);
+
+static const char *nombre_kernel(const struct config_mm *cfg){
+	return cfg->tile > 0 ? "bloques" : "simple";
+}
+
+// CPUs en las que el proceso puede ejecutarse; devuelve cuántas hay
+static int cpus_disponibles(int *lista, int max){
+	cpu_set_t conjunto;
+	int n = 0;
+	if(sched_getaffinity(0, sizeof(conjunto), &conjunto) != 0){
+		lista[0] = 0;
+		return 1;
+	}
+	for(int c = 0; c < CPU_SETSIZE && n < max; c++)
+		if(CPU_ISSET(c, &conjunto))
+			lista[n++] = c;
+	return n > 0 ? n : 1;
+}
+
+// CPU a la que se fija el hilo idH de nH según la afinidad (-1 si no se fija)
+static int cpu_hilo(int afinidad, int idH, int nH){
+	int lista[CPU_SETSIZE];
+	int n = cpus_disponibles(lista, CPU_SETSIZE);
+	if(afinidad == AFINIDAD_COMPACTA)
+		return lista[idH % n];
+	if(afinidad == AFINIDAD_DISPERSA)
+		return lista[((long) idH * n / nH) % n];
+	return -1;
+}
+
+// Modelo de CPU (de /proc/cpuinfo) y número de CPUs disponibles, que forman la clave de la máquina
+static void modelo_cpu(char *modelo, size_t tam){
+	char linea[LINEA_AJUSTE];
+	int lista[CPU_SETSIZE];
+	char nombre[LINEA_AJUSTE] = "desconocido";
+	FILE *f = fopen("/proc/cpuinfo", "r");
+	if(f != NULL){
+		while(fgets(linea, sizeof(linea), f) != NULL){
+			char *dos_puntos = strchr(linea, ':');
+			if(strncmp(linea, "model name", 10) == 0 && dos_puntos != NULL){
+				char *v = dos_puntos + 1;
+				while(*v == ' ') v++;
+				v[strcspn(v, "\n")] = '\0';
+				snprintf(nombre, sizeof(nombre), "%s", v);
+				break;
+			}
+		}
+		fclose(f);
+	}
+	for(char *c = nombre; *c; c++) // El ';' separa los campos del fichero de ajuste
+		if(*c == ';') *c = ',';
+	snprintf(modelo, tam, "%s (%d CPU)", nombre, cpus_disponibles(lista, CPU_SETSIZE));
+}
+
+// Ruta del fichero de ajuste: $MM_AJUSTE o ~/.mm_ajuste
+static void ruta_ajuste(char *ruta, size_t tam){
+	const char *env = getenv("MM_AJUSTE");
+	const char *home = getenv("HOME");
+	if(env != NULL && *env)
+		snprintf(ruta, tam, "%s", env);
+	else
+		snprintf(ruta, tam, "%s/.mm_ajuste", home ? home : ".");
+}
+
+/* Busca en el fichero de ajuste la configuración del programa para N en esta
+máquina. Formato de cada línea: programa;modelo;N;kernel;tile;hilos;afinidad;tiempo_us
+Devuelve 1 si la encuentra*/
+static int cargar_ajuste(const char *programa, int N, struct config_mm *cfg){
+	char ruta[LINEA_AJUSTE], modelo[LINEA_AJUSTE], linea[2*LINEA_AJUSTE];
+	int encontrado = 0;
+	ruta_ajuste(ruta, sizeof(ruta));
+	modelo_cpu(modelo, sizeof(modelo));
+	FILE *f = fopen(ruta, "r");
+	if(f == NULL)
+		return 0;
+	while(fgets(linea, sizeof(linea), f) != NULL){
+		char *campos[8];
+		int n = 0;
+		for(char *tok = strtok(linea, ";\n"); tok != NULL && n < 8; tok = strtok(NULL, ";\n"))
+			campos[n++] = tok;
+		if(n < 8 || strcmp(campos[0], programa) != 0 || strcmp(campos[1], modelo) != 0 || atoi(campos[2]) != N)
+			continue;
+		cfg->tile = atoi(campos[4]);
+		cfg->hilos = atoi(campos[5]);
+		cfg->afinidad = AFINIDAD_NINGUNA;
+		for(int a = 0; a < 3; a++)
+			if(strcmp(campos[6], NOMBRES_AFINIDAD[a]) == 0) cfg->afinidad = a;
+		cfg->tiempo = atof(campos[7]);
+		encontrado = cfg->hilos > 0; // Una línea repetida posterior sustituye a la anterior
+	}
+	fclose(f);
+	return encontrado;
+}
+
+// Guarda la configuración ganadora sustituyendo la entrada previa del mismo programa, máquina y N
+static void guardar_ajuste(const char *programa, int N, const struct config_mm *cfg){
+	char ruta[LINEA_AJUSTE], temporal[LINEA_AJUSTE + 8], modelo[LINEA_AJUSTE], linea[2*LINEA_AJUSTE];
+	char clave[2*LINEA_AJUSTE];
+	ruta_ajuste(ruta, sizeof(ruta));
+	modelo_cpu(modelo, sizeof(modelo));
+	snprintf(temporal, sizeof(temporal), "%s.tmp", ruta);
+	snprintf(clave, sizeof(clave), "%s;%s;%d;", programa, modelo, N);
+
+	FILE *nuevo = fopen(temporal, "w");
+	if(nuevo == NULL){
+		perror("Error al crear el fichero de ajuste");
+		return;
+	}
+	FILE *viejo = fopen(ruta, "r");
+	if(viejo != NULL){
+		while(fgets(linea, sizeof(linea), viejo) != NULL)
+			if(strncmp(linea, clave, strlen(clave)) != 0)
+				fputs(linea, nuevo);
+		fclose(viejo);
+	}
+	fprintf(nuevo, "%s%s;%d;%d;%s;%.0f\n", clave, nombre_kernel(cfg), cfg->tile,
+		cfg->hilos, NOMBRES_AFINIDAD[cfg->afinidad], cfg->tiempo);
+	fclose(nuevo);
+	if(rename(temporal, ruta) != 0)
+		perror("Error al guardar el fichero de ajuste");
+}
+
+static int comparar_config(const void *a, const void *b){
+	double ta = ((const struct config_mm *) a)->tiempo, tb = ((const struct config_mm *) b)->tiempo;
+	return (ta > tb) - (ta < tb);
+}
+
+/* Búsqueda por eliminación sucesiva: todos los candidatos se prueban con una
+fracción de las filas, se conserva la mitad más rápida y se duplica la fracción
+hasta que queda uno. En la ronda con todas las filas se repite cada prueba para
+reducir el ruido y se toma el mínimo*/
+static struct config_mm buscar_ajuste(int N, prueba_mm_t prueba){
+	struct config_mm cand[MAX_CANDIDATOS];
+	int tiles[] = {0, 16, 32, 64, 128};
+	int lista[CPU_SETSIZE];
+	int ncpu = cpus_disponibles(lista, CPU_SETSIZE);
+	int max_hilos = ncpu > 8 ? ncpu : 8;
+	int n = 0;
+
+	for(int h = 1; h <= max_hilos && h <= N; h *= 2)
+		for(int t = 0; t < (int) (sizeof(tiles)/sizeof(tiles[0])); t++){
+			if(tiles[t] >= N) continue;
+			for(int a = AFINIDAD_NINGUNA; a <= AFINIDAD_DISPERSA && n < MAX_CANDIDATOS; a++){
+				if(a != AFINIDAD_NINGUNA && ncpu == 1) continue; // Con una CPU la afinidad no cambia nada
+				if(a == AFINIDAD_DISPERSA && h >= ncpu) continue; // Igual que la compacta
+				cand[n].tile = tiles[t];
+				cand[n].hilos = h;
+				cand[n].afinidad = a;
+				cand[n].tiempo = 0;
+				n++;
+			}
+		}
+
+	int filas = N/16 > 32 ? N/16 : 32;
+	if(filas > N) filas = N;
+	while(1){
+		int reps = filas == N ? 3 : 1;
+		for(int c = 0; c < n; c++){
+			cand[c].tiempo = -1;
+			for(int r = 0; r < reps; r++){
+				double t = prueba(N, &cand[c], filas);
+				if(cand[c].tiempo < 0 || t < cand[c].tiempo) cand[c].tiempo = t;
+			}
+		}
+		qsort(cand, n, sizeof(cand[0]), comparar_config);
+		printf("ajuste: %3d candidatos con %4d filas, mejor kernel=%s tile=%d hilos=%d afinidad=%s (%.0f µs)\n",
+			n, filas, nombre_kernel(&cand[0]), cand[0].tile, cand[0].hilos,
+			NOMBRES_AFINIDAD[cand[0].afinidad], cand[0].tiempo);
+		if(filas == N && n <= 2) // La ronda con todas las filas decide el ganador
+			break;
+		n = (n + 1) / 2;
+		filas = (n == 1 || filas*2 > N) ? N : filas*2;
+	}
+	return cand[0];
+}
+
+#endif
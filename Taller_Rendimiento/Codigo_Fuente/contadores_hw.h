@@ -0,0 +1,127 @@
+/**************************************************************
+		Pontificia Universidad Javeriana
+	Materia: Sistemas Operativos
+	Tema: Taller de Evaluación de Rendimiento
+	Fichero: contadores de rendimiento por hardware (perf_event_open).
+	Objetivo: Medir ciclos, instrucciones, fallos de caché L1/LLC,
+				fallos de dTLB y ciclos detenidos de cada hilo que
+				ejecuta la multiplicación, para relacionar el tiempo
+				con su causa en la microarquitectura.
+				Si el sistema no expone los contadores (por ejemplo en
+				una máquina virtual) se informa y el programa sigue.
+****************************************************************/
+
+#ifndef CONTADORES_HW_H
+#define CONTADORES_HW_H
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define NUM_CONTADORES 7
+
+// Descripción de cada evento: tipo, configuración y nombre para el reporte
+struct evento_hw {
+	unsigned int tipo;
+	unsigned long long config;
+	const char *nombre;
+};
+
+#define CACHE_HW(cache, op, res) \
+	((cache) | ((op) << 8) | ((res) << 16))
+
+static const struct evento_hw EVENTOS_HW[NUM_CONTADORES] = {
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "ciclos"},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instrucciones"},
+	{PERF_TYPE_HW_CACHE, CACHE_HW(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), "fallos_L1D"},
+	{PERF_TYPE_HW_CACHE, CACHE_HW(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), "fallos_LLC"},
+	{PERF_TYPE_HW_CACHE, CACHE_HW(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), "fallos_dTLB"},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND, "detenidos_front"},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND, "detenidos_back"},
+};
+
+// Contadores de un hilo: descriptor, valor leído y si el evento está disponible
+struct contadores_hw {
+	int fd[NUM_CONTADORES];
+	unsigned long long valor[NUM_CONTADORES];
+	int valido[NUM_CONTADORES];
+	int error; // errno del primer evento que no se pudo abrir (0 si ninguno)
+};
+
+static long perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int grupo, unsigned long flags){
+	return syscall(__NR_perf_event_open, attr, pid, cpu, grupo, flags);
+}
+
+// Abre y arranca los contadores para el hilo que la invoca
+static void contadores_iniciar(struct contadores_hw *hw){
+	memset(hw, 0, sizeof(*hw));
+	for(int e = 0; e < NUM_CONTADORES; e++){
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = EVENTOS_HW[e].tipo;
+		attr.config = EVENTOS_HW[e].config;
+		attr.disabled = 1; // Se habilitan todos juntos justo antes del cálculo
+		attr.exclude_kernel = 1; // Permite medir con perf_event_paranoid <= 2
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		hw->fd[e] = (int) perf_event_open(&attr, 0, -1, -1, 0); // Hilo actual, cualquier CPU
+		if(hw->fd[e] < 0 && hw->error == 0)
+			hw->error = errno;
+	}
+	for(int e = 0; e < NUM_CONTADORES; e++){
+		if(hw->fd[e] >= 0){
+			ioctl(hw->fd[e], PERF_EVENT_IOC_RESET, 0);
+			ioctl(hw->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+// Detiene, lee y cierra los contadores del hilo
+static void contadores_detener(struct contadores_hw *hw){
+	for(int e = 0; e < NUM_CONTADORES; e++)
+		if(hw->fd[e] >= 0)
+			ioctl(hw->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+
+	for(int e = 0; e < NUM_CONTADORES; e++){
+		if(hw->fd[e] < 0)
+			continue;
+		unsigned long long lectura[3]; // valor, tiempo habilitado, tiempo en ejecución
+		if(read(hw->fd[e], lectura, sizeof(lectura)) == sizeof(lectura) && lectura[2] > 0){
+			// Si el núcleo multiplexó los contadores se escala al tiempo total
+			hw->valor[e] = (unsigned long long) ((double) lectura[0] * lectura[1] / lectura[2]);
+			hw->valido[e] = 1;
+		}
+		close(hw->fd[e]);
+		hw->fd[e] = -1;
+	}
+}
+
+// Imprime los contadores de un hilo o proceso ('quien') en una línea (n/d si el evento no está disponible)
+static void contadores_imprimir(const char *quien, int id, struct contadores_hw *hw){
+	int alguno = 0;
+	for(int e = 0; e < NUM_CONTADORES; e++)
+		alguno |= hw->valido[e];
+	if(!alguno){
+		printf("%s %2d: contadores HW no disponibles (%s)\n", quien, id,
+			hw->error ? strerror(hw->error) : "sin lectura");
+		return;
+	}
+
+	printf("%s %2d:", quien, id);
+	for(int e = 0; e < NUM_CONTADORES; e++){
+		if(hw->valido[e])
+			printf(" %s=%llu", EVENTOS_HW[e].nombre, hw->valor[e]);
+		else
+			printf(" %s=n/d", EVENTOS_HW[e].nombre);
+	}
+	if(hw->valido[0] && hw->valido[1] && hw->valor[0] > 0)
+		printf(" IPC=%.2f", (double) hw->valor[1] / hw->valor[0]);
+	printf("\n");
+}
+
+#endif
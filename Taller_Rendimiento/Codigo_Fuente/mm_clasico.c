@@ -12,23 +12,38 @@
 				Se implementa con la Biblioteca POSIX Pthreads
 ****************************************************************/
 
+#define _GNU_SOURCE // Necesario para la afinidad de los hilos (pthread_setaffinity_np)
 #include <stdio.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <time.h>
 #include <sys/time.h>
+#include <string.h>
+#include "contadores_hw.h"
+#include "autotune_mm.h"
+#include "procesos_mm.h"
+#include "tipos_mm.h"
+#include "abft_mm.h"
 
 #define DATA_SIZE (1024*1024*64*3) 
+#define PROGRAMA "MM_clasico" // Nombre del programa en el fichero de ajuste
+#define B_TRANSPUESTA 0 // B se guarda por filas
 
 pthread_mutex_t MM_mutex; // Mutex para sincronización de acceso a recursos compartidos
-static double MEM_CHUNK[DATA_SIZE]; // Memoria compartida para almacenar las matrices
-double *mA, *mB, *mC; // Punteros a las matrices A, B y C
+static unsigned char MEM_CHUNK[DATA_SIZE*sizeof(double)] __attribute__((aligned(ALINEACION_MM))); // Memoria para almacenar las matrices, en bytes: su tipo depende del modo (-t)
+void *mA, *mB, *mC; // Punteros a las matrices A, B y C (con los tipos del modo elegido)
+const struct tipo_mm *tipo; // Modo de precisión: tipo de A y B y de la acumulación (-t)
 
 struct parametros{
 	int nH; // Número total de hilos
 	int idH; // Identificador del hilo actual
 	int N; // Tamaño de las matrices (NxN)
+	int filas; // Filas a calcular (N, o menos en las pruebas cortas del ajuste)
+	int tile; // Tamaño de bloque del kernel (0 = kernel simple)
+	int cpu; // CPU a la que se fija el hilo (-1 = sin afinidad)
+	int contadores; // 1 si se miden los contadores HW del hilo (-c)
+	struct contadores_hw hw; // Lecturas de los contadores HW del hilo
 };
 
 struct timeval start, stop; // Variables para medir el tiempo de ejecución
@@ -37,18 +52,18 @@ struct timeval start, stop; // Variables para medir el tiempo de ejecución
 void llenar_matriz(int SZ){ 
 	srand48(time(NULL)); // Inicialización de la semilla aleatoria
 	for(int i = 0; i < SZ*SZ; i++){
-		mA[i] = 1.1*i; // Inicialización de la matriz A
-		mB[i] = 2.2*i; // Inicialización de la matriz B
-		mC[i] = 0; // Inicialización de la matriz C
+		tipo->escribir_elem(mA, i, valor_inicial_mm('A', i, tipo->entero)); // Inicialización de la matriz A
+		tipo->escribir_elem(mB, i, valor_inicial_mm('B', i, tipo->entero)); // Inicialización de la matriz B
 	}	
+	memset(mC, 0, (size_t) SZ*SZ*tipo->tam_acum); // Inicialización de la matriz C
 }
 
 // Función para imprimir una matriz
-void print_matrix(int sz, double *matriz){
+void print_matrix(int sz, void *matriz, leer_mm_t leer){
 	if(sz < 12){
 		for(int i = 0; i < sz*sz; i++){
 			if(i%sz==0) printf("\n");
-			printf(" %.3f ", matriz[i]);
+			printf(" %.3f ", leer(matriz, i));
 		}	
 		printf("\n>-------------------->\n");
 	}
@@ -59,10 +74,87 @@ void inicial_tiempo(){
 	gettimeofday(&start, NULL); // Inicio del contador de tiempo
 }
 
-void final_tiempo(){
+double final_tiempo(){
 	gettimeofday(&stop, NULL); // Fin del contador de tiempo
 	stop.tv_sec -= start.tv_sec; // Cálculo del tiempo transcurrido en segundos
-	printf("\n:-> %9.0f µs\n", (double) (stop.tv_sec*1000000 + stop.tv_usec)); // Impresión del tiempo transcurrido
+	double us = (double) (stop.tv_sec*1000000 + stop.tv_usec - start.tv_usec); // Tiempo transcurrido en µs
+	printf("\n:-> %9.0f µs\n", us); // Impresión del tiempo transcurrido
+	return us;
+}
+
+/* Kernels para elementos TE con acumulación en TA sobre el bloque [fi,ff) x [ci,cf) de C.
+Simple: producto punto de la fila i de A con la columna j de B.
+Por bloques: trabaja sobre bloques tile x tile de A, B y C para reutilizarlos en caché;
+dentro del bloque el orden i-k-j recorre B y C por filas (acceso contiguo), lo que
+permite vectorizar el bucle interno con tantos elementos como quepan en un registro*/
+#define DEFINIR_KERNELS(SUF, TE, TA) \
+void multiplicar_simple_##SUF(int N, int fi, int ff, int ci, int cf){ \
+	const TE *A = (const TE *) mA, *B = (const TE *) mB; \
+	TA *C = (TA *) mC; \
+	for (int i = fi; i < ff; i++){ /* Bucle sobre las filas del bloque asignado */ \
+		for (int j = ci; j < cf; j++){ /* Bucle sobre las columnas del bloque asignado */ \
+			const TE *pA = A + (i*N), *pB = B + j; /* Fila i de A y columna j de B */ \
+			TA sumaTemp = 0; /* Suma en el tipo de acumulación */ \
+			for (int k = 0; k < N; k++, pA++, pB+=N) \
+				sumaTemp += (TA) *pA * *pB; /* Multiplicación y acumulación de productos */ \
+			C[i*N+j] = sumaTemp; \
+		} \
+	} \
+} \
+void multiplicar_bloques_##SUF(int N, int fi, int ff, int ci, int cf, int tile){ \
+	const TE *A = (const TE *) mA, *B = (const TE *) mB; \
+	TA *C = (TA *) mC; \
+	for (int i = fi; i < ff; i++) /* C se acumula por bloques de k, se parte de cero */ \
+		for (int j = ci; j < cf; j++) \
+			C[i*N+j] = 0; \
+	for (int ii = fi; ii < ff; ii += tile){ \
+		int iMax = ii+tile < ff ? ii+tile : ff; \
+		for (int kk = 0; kk < N; kk += tile){ /* Paneles de k, como los pasos de SUMMA */ \
+			int kMax = kk+tile < N ? kk+tile : N; \
+			for (int jj = ci; jj < cf; jj += tile){ \
+				int jMax = jj+tile < cf ? jj+tile : cf; \
+				for (int i = ii; i < iMax; i++){ \
+					TA *pC = C + (i*N); /* Fila i de la matriz C */ \
+					for (int k = kk; k < kMax; k++){ \
+						TA a = A[i*N+k]; /* Elemento de A reutilizado en toda la fila del bloque */ \
+						const TE *pB = B + (k*N); /* Fila k de la matriz B */ \
+						for (int j = jj; j < jMax; j++) \
+							pC[j] += a * pB[j]; \
+					} \
+				} \
+			} \
+		} \
+	} \
+}
+
+DEFINIR_KERNELS(d, double, double)
+DEFINIR_KERNELS(f, float, float)
+DEFINIR_KERNELS(fd, float, double)
+DEFINIR_KERNELS(i16, int16_t, int32_t)
+DEFINIR_KERNELS(i8, int8_t, int32_t)
+
+// Modos de precisión disponibles con -t (el primero es el de por omisión)
+static const struct tipo_mm TIPOS[] = {
+	TIPO_MM(d, "d", double, f64, double, f64, 0, DBL_EPSILON), // double
+	TIPO_MM(f, "f", float, f32, float, f32, 0, FLT_EPSILON), // float
+	TIPO_MM(fd, "fd", float, f32, double, f64, 0, DBL_EPSILON), // float con acumulación double
+	TIPO_MM(i16, "i16", int16_t, i16, int32_t, i32, 1, 0), // int16 con acumulación int32
+	TIPO_MM(i8, "i8", int8_t, i8, int32_t, i32, 1, 0), // int8 con acumulación int32
+};
+#define NUM_TIPOS ((int) (sizeof(TIPOS)/sizeof(TIPOS[0])))
+
+// Cálculo del bloque [fi,ff) x [ci,cf) de C con el kernel elegido (tile 0 = simple)
+void multiplicar_bloque(int N, int fi, int ff, int ci, int cf, int tile){
+	if (tile > 0)
+		tipo->bloques(N, fi, ff, ci, cf, tile);
+	else
+		tipo->simple(N, fi, ff, ci, cf);
+}
+
+// Franja de filas [ini,fin) del hilo idH de nH; el último hilo se queda con las filas sobrantes
+void franja_hilo(int filas, int nH, int idH, int *ini, int *fin){
+	*ini = (filas/nH)*idH;
+	*fin = (idH == nH-1) ? filas : (filas/nH)*(idH+1);
 }
 
 // Función ejecutada por cada hilo para multiplicar por bloques de la matriz
@@ -72,66 +164,193 @@ void *mult_thread(void *variables){
 	int idH = data->idH; // Identificador del hilo
 	int nH  = data->nH; // Número total de hilos
 	int N   = data->N; // Tamaño de las matrices
-	int ini = (N/nH)*idH; // Índice inicial para la división de trabajo
-	int fin = (N/nH)*(idH+1); // Índice final para la división de trabajo
-
-	for (int i = ini; i < fin; i++){ // Bucle sobre las filas del bloque asignado al hilo
-		for (int j = 0; j < N; j++){ // Bucle sobre las columnas de la matriz B
-			double *pA, *pB, sumaTemp = 0.0; // Punteros y variable temporal para la suma
-			pA = mA + (i*N); // Puntero al inicio de la fila i de la matriz A
-			pB = mB + j; // Puntero a la columna j de la matriz B
-			for (int k = 0; k < N; k++, pA++, pB+=N){ // Bucle para multiplicar y sumar los elementos
-				sumaTemp += (*pA * *pB); // Multiplicación y acumulación de productos
-			}
-			mC[i*N+j] = sumaTemp; // Asignación del resultado a la posición correspondiente de la matriz C
-		}
+	int filas = data->filas; // Filas a repartir entre los hilos
+	int ini, fin; // Índices inicial y final para la división de trabajo
+	franja_hilo(filas, nH, idH, &ini, &fin);
+
+	if (data->cpu >= 0){ // Fijación del hilo a la CPU elegida por la afinidad
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(data->cpu, &cpus);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
 	}
 
+	if (data->contadores) contadores_iniciar(&data->hw); // Arranque de los contadores justo antes del cálculo
+
+	multiplicar_bloque(N, ini, fin, 0, N, data->tile); // Franja de filas del hilo, todas las columnas
+
+	if (data->contadores) contadores_detener(&data->hw); // Lectura de los contadores al terminar el bloque
+
 	pthread_mutex_lock (&MM_mutex); // Bloqueo del mutex para sincronización
 	pthread_mutex_unlock (&MM_mutex); // Desbloqueo del mutex
 	pthread_exit(NULL); // Salida del hilo
 }
 
+// Creación de los hilos de una configuración (parámetros de cada uno en datos[]) y espera a que terminen
+void lanzar_hilos(int SZ, const struct config_mm *cfg, int filas, int contadores, struct parametros *datos){
+	int n_threads = cfg->hilos; // Número de hilos a utilizar
+	pthread_t p[n_threads]; // Arreglo de identificadores de hilos
+	pthread_attr_t atrMM; // Atributos para los hilos
+
+	pthread_attr_init(&atrMM); // Inicialización de los atributos de los hilos
+	pthread_attr_setdetachstate(&atrMM, PTHREAD_CREATE_JOINABLE); // Establecimiento de los atributos para permitir la unión de los hilos
+
+	for (int j=0; j<n_threads; j++){ // Bucle para la creación de los hilos
+		datos[j].idH = j; // Asignación del identificador del hilo
+		datos[j].nH  = n_threads; // Asignación del número total de hilos
+		datos[j].N   = SZ; // Asignación del tamaño de las matrices
+		datos[j].filas = filas; // Filas a calcular
+		datos[j].tile = cfg->tile; // Kernel y tamaño de bloque
+		datos[j].cpu = cpu_hilo(cfg->afinidad, j, n_threads); // CPU según la afinidad
+		datos[j].contadores = contadores; // Activación de los contadores HW del hilo
+		pthread_create(&p[j],&atrMM,mult_thread,(void *)&datos[j]); // Creación del hilo con los argumentos dados
+	}
+
+	for (int j=0; j<n_threads; j++) // Bucle para la unión de los hilos
+		pthread_join(p[j],NULL); // Unión de los hilos con el hilo principal
+
+	pthread_attr_destroy(&atrMM); // Destrucción de los atributos de los hilos
+}
+
+// Prueba corta del ajuste: tiempo en µs de calcular las primeras 'filas' filas con la configuración dada
+double prueba_mm(int SZ, const struct config_mm *cfg, int filas){
+	struct parametros datos[cfg->hilos];
+	struct timeval t0, t1;
+	gettimeofday(&t0, NULL);
+	lanzar_hilos(SZ, cfg, filas, 0, datos);
+	gettimeofday(&t1, NULL);
+	return (t1.tv_sec - t0.tv_sec)*1e6 + (t1.tv_usec - t0.tv_usec);
+}
+
+// Ubicación de A, B y C a partir de 'base' según los tamaños del tipo elegido
+void ubicar_matrices(void *base, int SZ){
+	mA = base; // Asignación de memoria para la matriz A
+	mB = (char *) base + bytes_entradas_mm(tipo, SZ)/2; // Asignación de memoria para la matriz B
+	mC = (char *) base + bytes_entradas_mm(tipo, SZ); // Asignación de memoria para la matriz C
+}
+
 int main(int argc, char *argv[]){
 	if (argc < 2){
-		printf("Ingreso de argumentos \n $./ejecutable tamMatriz numHilos\n"); // Verificación de argumentos de línea de comandos
+		printf("Ingreso de argumentos \n $./ejecutable tamMatriz [numHilos] [-c] [-a] [-n] [-P] [-v] [-t d|f|fd|i16|i8]\n"); // Verificación de argumentos de línea de comandos
 		return -1;	
 	}
 	int SZ = atoi(argv[1]); // Tamaño de las matrices
-	int n_threads = atoi(argv[2]); // Número de hilos a utilizar
+	int n_threads = (argc > 2 && argv[2][0] != '-') ? atoi(argv[2]) : 0; // Número de hilos a utilizar (0 = el del ajuste)
+	int contadores = 0; // Medición de contadores HW por hilo (-c)
+	int autotune = 0; // Búsqueda de la mejor configuración para este tamaño (-a)
+	int sin_ajuste = 0; // Ignorar el fichero de ajuste (-n)
+	int procesos = 0; // Backend de procesos con memoria compartida en lugar de hilos (-P)
+	int verificar = 0; // Verificación ABFT del resultado en O(N²) (-v)
+	const char *nombre_tipo = "d"; // Modo de precisión (-t): d, f, fd, i16 o i8
+	for (int i = 2; i < argc; i++){ // Opciones adicionales tras los argumentos posicionales
+		if (strcmp(argv[i], "-c") == 0)
+			contadores = 1;
+		else if (strcmp(argv[i], "-a") == 0)
+			autotune = 1;
+		else if (strcmp(argv[i], "-n") == 0)
+			sin_ajuste = 1;
+		else if (strcmp(argv[i], "-P") == 0)
+			procesos = 1;
+		else if (strcmp(argv[i], "-v") == 0)
+			verificar = 1;
+		else if (strcmp(argv[i], "-t") == 0 && i+1 < argc)
+			nombre_tipo = argv[++i];
+	}
 
-	pthread_t p[n_threads]; // Arreglo de identificadores de hilos
-	pthread_attr_t atrMM; // Atributos para los hilos
+	tipo = buscar_tipo(TIPOS, NUM_TIPOS, nombre_tipo);
+	if (tipo == NULL){
+		printf("Tipo desconocido: %s (d, f, fd, i16, i8)\n", nombre_tipo);
+		return -1;
+	}
+	char programa[64]; // Clave en el fichero de ajuste: el modo forma parte de ella salvo el de por omisión
+	snprintf(programa, sizeof(programa), tipo == &TIPOS[0] ? "%s" : "%s-%s", PROGRAMA, tipo->nombre);
 
-	mA = MEM_CHUNK; // Asignación de memoria para la matriz A
-	mB = mA + SZ*SZ; // Asignación de memoria para la matriz B
-	mC = mB + SZ*SZ; // Asignación de memoria para la matriz C
+	struct config_mm cfg = {0, 0, AFINIDAD_NINGUNA, 0}; // Por omisión: kernel simple sin afinidad
+	int ajustado = 0; // 1 si la configuración viene del ajuste
+
+	if (SZ < 1 || bytes_matrices_mm(tipo, SZ) > sizeof(MEM_CHUNK)){ // A, B y C deben caber en la memoria estática
+		printf("Tamaño de matriz no válido para el tipo %s: %d (máximo %zu bytes para A, B y C)\n", tipo->nombre, SZ, sizeof(MEM_CHUNK));
+		return -1;
+	}
+	ubicar_matrices(MEM_CHUNK, SZ); // Asignación de memoria para las matrices A, B y C
 
 	llenar_matriz(SZ); // Llenado de las matrices con valores aleatorios
-	print_matrix(SZ, mA); // Impresión de la matriz A
-	print_matrix(SZ, mB); // Impresión de la matriz B
+	print_matrix(SZ, mA, tipo->leer_elem); // Impresión de la matriz A
+	print_matrix(SZ, mB, tipo->leer_elem); // Impresión de la matriz B
 
-	inicial_tiempo(); // Inicio de la medición del tiempo
 	pthread_mutex_init(&MM_mutex, NULL); // Inicialización del mutex
-	pthread_attr_init(&atrMM); // Inicialización de los atributos de los hilos
-	pthread_attr_setdetachstate(&atrMM, PTHREAD_CREATE_JOINABLE); // Establecimiento de los atributos para permitir la unión de los hilos
 
-	for (int j=0; j<n_threads; j++){ // Bucle para la creación de los hilos
-		struct parametros *datos = (struct parametros *) malloc(sizeof(struct parametros)); // Asignación de memoria para los argumentos del hilo
-		datos->idH = j; // Asignación del identificador del hilo
-		datos->nH  = n_threads; // Asignación del número total de hilos
-		datos->N   = SZ; // Asignación del tamaño de las matrices
-		pthread_create(&p[j],&atrMM,mult_thread,(void *)datos); // Creación del hilo con los argumentos dados
+	if (autotune){ // Búsqueda y registro de la mejor configuración
+		cfg = buscar_ajuste(SZ, prueba_mm);
+		guardar_ajuste(programa, SZ, &cfg);
+		ajustado = 1;
+	} else if (!sin_ajuste)
+		ajustado = cargar_ajuste(programa, SZ, &cfg); // Configuración guardada para este tamaño y máquina
+	if (n_threads > 0)
+		cfg.hilos = n_threads; // El número de hilos indicado tiene prioridad sobre el ajuste
+	if (cfg.hilos <= 0){ // Sin número de hilos ni ajuste: un hilo por CPU disponible
+		int lista[CPU_SETSIZE];
+		cfg.hilos = cpus_disponibles(lista, CPU_SETSIZE);
 	}
+	if (ajustado)
+		printf("ajuste: kernel=%s tile=%d hilos=%d afinidad=%s\n", nombre_kernel(&cfg), cfg.tile, cfg.hilos, NOMBRES_AFINIDAD[cfg.afinidad]);
 
-	for (int j=0; j<n_threads; j++) // Bucle para la unión de los hilos
-		pthread_join(p[j],NULL); // Unión de los hilos con el hilo principal
+	struct parametros *datos_hilos = NULL; // Parámetros de cada hilo, se conservan para leer sus contadores
+	struct control_procesos *ctl = NULL; // Memoria compartida y barrera del backend de procesos
+	if (procesos){ // Las matrices pasan a memoria compartida y los trabajadores se crean antes de medir
+		ctl = procesos_crear(bytes_matrices_mm(tipo, SZ), cfg.hilos);
+		memcpy(ctl->matrices, mA, bytes_entradas_mm(tipo, SZ)); // A y B son contiguas
+		ubicar_matrices(ctl->matrices, SZ); // C parte de cero (ftruncate rellena con ceros)
+		int cpus[cfg.hilos]; // CPU de cada proceso según la afinidad
+		for (int j=0; j<cfg.hilos; j++)
+			cpus[j] = cpu_hilo(cfg.afinidad, j, cfg.hilos);
+		printf("procesos: %d en malla %dx%d\n", ctl->nP, ctl->pr, ctl->pc);
+		procesos_lanzar(ctl, SZ, cfg.tile, cpus, contadores, multiplicar_bloque);
+	} else
+		datos_hilos = (struct parametros *) malloc(cfg.hilos*sizeof(struct parametros));
 
-	final_tiempo(); // Finalización de la medición del tiempo
+	int fallos = 0; // Trabajadores que terminaron de forma anormal (-P)
+	inicial_tiempo(); // Inicio de la medición del tiempo
+	if (procesos){
+		pthread_barrier_wait(&ctl->inicio); // Se libera a los trabajadores con la medición ya en marcha
+		fallos = procesos_esperar(ctl); // Fin de todos los trabajadores (o de todos tras un fallo)
+	} else
+		lanzar_hilos(SZ, &cfg, SZ, contadores, datos_hilos); // Multiplicación con los hilos de la configuración
+	double us = final_tiempo(); // Finalización de la medición del tiempo
+	reportar_rendimiento(tipo, SZ, us); // Rendimiento y ancho de banda del tipo
+	if (tipo != &TIPOS[0])
+		error_referencia(tipo, SZ, mC, B_TRANSPUESTA); // Error de la precisión reducida frente a double
 
-	print_matrix(SZ, mC); // Impresión de la matriz resultante C
+	for (int j=0; j<cfg.hilos && contadores; j++) // Contadores HW de cada hilo o proceso junto al tiempo medido
+		contadores_imprimir(procesos ? "proceso" : "hilo", j, procesos ? &ctl->hw[j] : &datos_hilos[j].hw);
+
+	int errores = 0; // Filas y columnas de C que no cuadran en la verificación
+	if (verificar){ // Verificación fuera de la medición, con los bloques de cada hilo o proceso
+		struct bloque_mm bloques[cfg.hilos];
+		struct timeval t0, t1;
+		for (int j=0; j<cfg.hilos; j++){
+			if (procesos)
+				procesos_bloque(ctl, SZ, j, &bloques[j].fi, &bloques[j].ff, &bloques[j].ci, &bloques[j].cf);
+			else {
+				franja_hilo(SZ, cfg.hilos, j, &bloques[j].fi, &bloques[j].ff);
+				bloques[j].ci = 0;
+				bloques[j].cf = SZ;
+			}
+		}
+		gettimeofday(&t0, NULL);
+		errores = verificar_abft(SZ, tipo, mA, mB, mC, B_TRANSPUESTA, bloques, cfg.hilos, procesos ? "proceso" : "hilo");
+		gettimeofday(&t1, NULL);
+		printf("ABFT: verificación en %.0f µs\n", (t1.tv_sec - t0.tv_sec)*1e6 + (t1.tv_usec - t0.tv_usec));
+	}
+
+	print_matrix(SZ, mC, tipo->leer_acum); // Impresión de la matriz resultante C
+
+	if (procesos){ // Recogida de los trabajadores y liberación de la memoria compartida
+		procesos_destruir(ctl);
+	} else
+		free(datos_hilos);
 
-	pthread_attr_destroy(&atrMM); // Destrucción de los atributos de los hilos
 	pthread_mutex_destroy(&MM_mutex); // Destrucción del mutex
+	if (errores || fallos) exit(EXIT_FAILURE); // Resultado incorrecto o trabajador caído: estado de salida de error
 	pthread_exit (NULL); // Salida del programa
 }
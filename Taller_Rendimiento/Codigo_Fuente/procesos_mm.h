@@ -0,0 +1,188 @@
+/**************************************************************
+		Pontificia Universidad Javeriana
+	Materia: Sistemas Operativos
+	Tema: Taller de Evaluación de Rendimiento
+	Fichero: multiplicación de matrices con procesos (fork).
+	Objetivo: Comparar el paralelismo por procesos con el de hilos.
+				Las matrices A, B y C viven en memoria compartida
+				(shm_open + mmap) y cada proceso trabajador calcula un
+				bloque de C de una malla 2D pr x pc (descomposición
+				tipo SUMMA) en lugar de una franja de filas.
+				El arranque se sincroniza con una barrera compartida
+				entre procesos (PTHREAD_PROCESS_SHARED) y el final con
+				waitpid, de modo que un trabajador que muere no deja
+				bloqueados al padre ni al resto.
+				Compilar con -pthread (y -lrt en glibc antiguas).
+****************************************************************/
+
+#ifndef PROCESOS_MM_H
+#define PROCESOS_MM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "contadores_hw.h"
+
+#define MAX_PROCESOS 256
+#define PAGINA_PROCESOS 4096
+
+// Función del programa que calcula el bloque de C [fi,ff) x [ci,cf)
+typedef void (*multiplicar_bloque_t)(int N, int fi, int ff, int ci, int cf, int tile);
+
+// Región de control al inicio de la memoria compartida, seguida de las matrices
+struct control_procesos {
+	pthread_barrier_t inicio; // Todos los trabajadores listos: empieza el cálculo
+	int nP, pr, pc;           // Número de procesos y malla pr x pc
+	size_t bytes;             // Tamaño total de la región compartida
+	pid_t pids[MAX_PROCESOS];
+	struct contadores_hw hw[MAX_PROCESOS]; // Contadores HW de cada proceso (-c)
+	void *matrices;           // Inicio de A, B y C dentro de la región
+};
+
+// Malla pr x pc con pr*pc = nP y pr lo más cercano posible a la raíz de nP
+static void malla_procesos(int nP, int *pr, int *pc){
+	*pr = 1;
+	for(int r = 1; r*r <= nP; r++)
+		if(nP % r == 0) *pr = r;
+	*pc = nP / *pr;
+}
+
+/* Crea la región compartida con espacio para 'bytes_matrices' bytes de matrices y
+la barrera de inicio para nP procesos más el padre. El nombre se desvincula enseguida:
+la región sigue accesible para el padre y los hijos por herencia en fork*/
+static struct control_procesos *procesos_crear(size_t bytes_matrices, int nP){
+	char nombre[64];
+	size_t cabecera = (sizeof(struct control_procesos) + PAGINA_PROCESOS - 1) / PAGINA_PROCESOS * PAGINA_PROCESOS;
+	size_t bytes = cabecera + bytes_matrices;
+
+	if(nP < 1 || nP > MAX_PROCESOS){
+		fprintf(stderr, "Número de procesos fuera de rango (1-%d)\n", MAX_PROCESOS);
+		exit(EXIT_FAILURE);
+	}
+	snprintf(nombre, sizeof(nombre), "/mm_procesos_%d", (int) getpid());
+	int fd = shm_open(nombre, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if(fd < 0){
+		perror("Error al crear la memoria compartida");
+		exit(EXIT_FAILURE);
+	}
+	if(ftruncate(fd, bytes) != 0){
+		perror("Error al dimensionar la memoria compartida");
+		shm_unlink(nombre);
+		exit(EXIT_FAILURE);
+	}
+	struct control_procesos *ctl = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	shm_unlink(nombre);
+	if(ctl == MAP_FAILED){
+		perror("Error al proyectar la memoria compartida");
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_barrierattr_t atrB;
+	pthread_barrierattr_init(&atrB);
+	pthread_barrierattr_setpshared(&atrB, PTHREAD_PROCESS_SHARED);
+	pthread_barrier_init(&ctl->inicio, &atrB, nP + 1);
+	pthread_barrierattr_destroy(&atrB);
+
+	ctl->nP = nP;
+	ctl->bytes = bytes;
+	malla_procesos(nP, &ctl->pr, &ctl->pc);
+	ctl->matrices = (char *) ctl + cabecera;
+	return ctl;
+}
+
+// Bloque [fi,ff) x [ci,cf) de C que corresponde al proceso idP (fila r, columna c de la malla)
+static void procesos_bloque(const struct control_procesos *ctl, int N, int idP, int *fi, int *ff, int *ci, int *cf){
+	int r = idP / ctl->pc, c = idP % ctl->pc;
+	*fi = (int) ((long) N * r / ctl->pr);
+	*ff = (int) ((long) N * (r+1) / ctl->pr);
+	*ci = (int) ((long) N * c / ctl->pc);
+	*cf = (int) ((long) N * (c+1) / ctl->pc);
+}
+
+// Trabajo de un proceso hijo: su bloque de la malla
+static void trabajador_proceso(struct control_procesos *ctl, int idP, int N, int tile, int cpu,
+		int contadores, multiplicar_bloque_t multiplicar){
+	int fi, ff, ci, cf;
+	procesos_bloque(ctl, N, idP, &fi, &ff, &ci, &cf);
+
+	if(cpu >= 0){ // Fijación del proceso a la CPU elegida por la afinidad
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+		sched_setaffinity(0, sizeof(cpus), &cpus);
+	}
+
+	pthread_barrier_wait(&ctl->inicio);
+	if(contadores) contadores_iniciar(&ctl->hw[idP]);
+	multiplicar(N, fi, ff, ci, cf, tile);
+	if(contadores) contadores_detener(&ctl->hw[idP]);
+	_exit(0); // El padre detecta el final de cada trabajador con waitpid
+}
+
+/* Crea los nP procesos trabajadores. 'cpus' indica la CPU de cada uno (-1 sin afinidad).
+Los hijos esperan en la barrera de inicio hasta que el padre también llegue*/
+static void procesos_lanzar(struct control_procesos *ctl, int N, int tile, const int *cpus,
+		int contadores, multiplicar_bloque_t multiplicar){
+	fflush(stdout); // Evita que los hijos hereden y repitan la salida pendiente
+	for(int p = 0; p < ctl->nP; p++){
+		pid_t pid = fork();
+		if(pid < 0){
+			perror("Error al crear el proceso trabajador");
+			for(int q = 0; q < p; q++)
+				kill(ctl->pids[q], SIGKILL);
+			exit(EXIT_FAILURE);
+		}
+		if(pid == 0)
+			trabajador_proceso(ctl, p, N, tile, cpus[p], contadores, multiplicar);
+		ctl->pids[p] = pid;
+	}
+}
+
+/* Espera a que terminen los hijos en el orden en que acaban. Si uno termina de forma
+anormal (señal o código distinto de 0) se matan los que siguen vivos, porque C queda
+incompleta. Devuelve cuántos trabajadores fallaron*/
+static int procesos_esperar(struct control_procesos *ctl){
+	int fallos = 0, vivos = ctl->nP;
+	while(vivos > 0){
+		int estado, p;
+		pid_t pid = waitpid(-1, &estado, 0);
+		if(pid < 0){
+			perror("Error al esperar a los procesos trabajadores");
+			return fallos + vivos;
+		}
+		for(p = 0; p < ctl->nP && ctl->pids[p] != pid; p++);
+		if(p == ctl->nP)
+			continue; // No es un trabajador
+		ctl->pids[p] = 0;
+		vivos--;
+		if(!WIFEXITED(estado) || WEXITSTATUS(estado) != 0){
+			if(fallos > 0 && WIFSIGNALED(estado) && WTERMSIG(estado) == SIGKILL)
+				continue; // Terminado por el padre tras el primer fallo
+			if(WIFSIGNALED(estado))
+				fprintf(stderr, "El proceso trabajador %d terminó por la señal %d\n", p, WTERMSIG(estado));
+			else
+				fprintf(stderr, "El proceso trabajador %d terminó con error\n", p);
+			if(fallos++ == 0) // Primer fallo: se termina el resto
+				for(int q = 0; q < ctl->nP; q++)
+					if(ctl->pids[q] > 0) kill(ctl->pids[q], SIGKILL);
+		}
+	}
+	return fallos;
+}
+
+// Libera la barrera y la región compartida
+static void procesos_destruir(struct control_procesos *ctl){
+	pthread_barrier_destroy(&ctl->inicio);
+	munmap(ctl, ctl->bytes);
+}
+
+#endif
@@ -0,0 +1,123 @@
+/**************************************************************
+		Pontificia Universidad Javeriana
+	Materia: Sistemas Operativos
+	Tema: Taller de Evaluación de Rendimiento
+	Fichero: tipos de elemento y de acumulación de la multiplicación.
+	Objetivo: Describir cada modo de precisión (double, float,
+				float con acumulación double, int16 e int8 con
+				acumulación int32): tamaños, conversión a double para
+				imprimir y verificar, y los kernels que cada programa
+				genera para ese par de tipos. Incluye el error frente
+				a una referencia double y el reporte de rendimiento
+				y ancho de banda por tipo.
+****************************************************************/
+
+#ifndef TIPOS_MM_H
+#define TIPOS_MM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#define FILAS_REFERENCIA 8 // Filas de C que se comparan con la referencia double
+#define ALINEACION_MM 64   // Alineación de cada matriz dentro de la memoria
+
+typedef double (*leer_mm_t)(const void *m, size_t i);
+typedef void (*escribir_mm_t)(void *m, size_t i, double v);
+typedef void (*kernel_simple_t)(int N, int fi, int ff, int ci, int cf);
+typedef void (*kernel_bloques_t)(int N, int fi, int ff, int ci, int cf, int tile);
+
+// Lectura y escritura de un elemento de tipo T como double
+#define DEFINIR_ACCESO(SUF, T) \
+	__attribute__((unused)) static double leer_##SUF(const void *m, size_t i){ return (double) ((const T *) m)[i]; } \
+	__attribute__((unused)) static void escribir_##SUF(void *m, size_t i, double v){ ((T *) m)[i] = (T) v; }
+
+DEFINIR_ACCESO(f64, double)
+DEFINIR_ACCESO(f32, float)
+DEFINIR_ACCESO(i32, int32_t)
+DEFINIR_ACCESO(i16, int16_t)
+DEFINIR_ACCESO(i8, int8_t)
+
+// Modo de precisión: tipo de A y B (elemento) y tipo de C y de la suma (acumulador)
+struct tipo_mm {
+	const char *nombre;   // Nombre en la línea de comandos (-t)
+	const char *elem;     // Descripción del tipo de A y B
+	const char *acum;     // Descripción del tipo del acumulador y de C
+	size_t tam_elem, tam_acum;
+	int entero;           // 1 si la aritmética es entera (exacta)
+	double eps;           // Épsilon del acumulador, para la tolerancia de la verificación
+	leer_mm_t leer_elem, leer_acum;
+	escribir_mm_t escribir_elem;
+	kernel_simple_t simple;
+	kernel_bloques_t bloques;
+};
+
+/* Entrada de la tabla de tipos de un programa. SUF es el sufijo de los kernels
+multiplicar_simple_SUF y multiplicar_bloques_SUF que el programa genera*/
+#define TIPO_MM(SUF, NOMBRE, TE, ACC_E, TA, ACC_A, ENTERO, EPS) \
+	{NOMBRE, #ACC_E, #ACC_A, sizeof(TE), sizeof(TA), ENTERO, EPS, \
+	 leer_##ACC_E, leer_##ACC_A, escribir_##ACC_E, multiplicar_simple_##SUF, multiplicar_bloques_##SUF}
+
+// Busca un modo por nombre en la tabla del programa (NULL si no existe)
+static const struct tipo_mm *buscar_tipo(const struct tipo_mm *tabla, int n, const char *nombre){
+	for(int t = 0; t < n; t++)
+		if(strcmp(tabla[t].nombre, nombre) == 0)
+			return &tabla[t];
+	return NULL;
+}
+
+// Desplazamientos de A, B y C en bytes, alineados para que C sea accesible con su tipo
+static size_t alinear_mm(size_t bytes){
+	return (bytes + ALINEACION_MM - 1) / ALINEACION_MM * ALINEACION_MM;
+}
+static size_t bytes_entradas_mm(const struct tipo_mm *tipo, int N){ // A y B
+	return 2 * alinear_mm((size_t) N * N * tipo->tam_elem);
+}
+static size_t bytes_matrices_mm(const struct tipo_mm *tipo, int N){ // A, B y C
+	return bytes_entradas_mm(tipo, N) + alinear_mm((size_t) N * N * tipo->tam_acum);
+}
+
+/* Valor inicial del elemento i de A (matriz 'A') o de B ('B') en double. En los modos
+enteros se usan valores pequeños para que int8 los represente y la suma no desborde*/
+static double valor_inicial_mm(char matriz, size_t i, int entero){
+	if(entero)
+		return matriz == 'A' ? (double) (i % 7) - 3 : (double) (i % 5) - 2;
+	return matriz == 'A' ? 1.1*i : 2.2*i;
+}
+
+/* Error del resultado frente a una referencia calculada en double con los valores
+iniciales sin convertir, sobre FILAS_REFERENCIA filas repartidas por C (cada una
+cuesta O(N²)). Incluye el redondeo de las entradas al tipo y el de la acumulación;
+en los modos enteros debe ser cero salvo desbordamiento*/
+static void error_referencia(const struct tipo_mm *tipo, int N, const void *mC, int b_transpuesta){
+	int pasos = N < FILAS_REFERENCIA ? N : FILAS_REFERENCIA;
+	double errMax = 0.0, refMax = 0.0;
+	for(int p = 0; p < pasos; p++){
+		int i = (int) ((long) N * p / pasos);
+		for(int j = 0; j < N; j++){
+			double ref = 0.0;
+			for(int k = 0; k < N; k++)
+				ref += valor_inicial_mm('A', (size_t) i*N+k, tipo->entero) *
+					valor_inicial_mm('B', b_transpuesta ? (size_t) j*N+k : (size_t) k*N+j, tipo->entero);
+			double err = fabs(tipo->leer_acum(mC, (size_t) i*N+j) - ref);
+			if(err > errMax) errMax = err;
+			if(fabs(ref) > refMax) refMax = fabs(ref);
+		}
+	}
+	printf("error frente a referencia double (%d filas): absoluto %.3e, relativo %.3e\n",
+		pasos, errMax, refMax > 0 ? errMax / refMax : 0.0);
+}
+
+/* Rendimiento de la ejecución: 2·N³ operaciones y el tráfico mínimo con memoria
+(leer A y B y escribir C una vez), que es una cota inferior del ancho de banda usado*/
+static void reportar_rendimiento(const struct tipo_mm *tipo, int N, double us){
+	double ops = 2.0 * N * N * (double) N;
+	double bytes = (double) N * N * (2*tipo->tam_elem + tipo->tam_acum);
+	if(us <= 0) us = 1;
+	printf("tipo %s (%s, acumulador %s): %.3f %s, %.3f GB/s mínimo\n", tipo->nombre, tipo->elem, tipo->acum,
+		ops / us / 1e3, tipo->entero ? "GOP/s" : "GFLOP/s", bytes / us / 1e3);
+}
+
+#endif